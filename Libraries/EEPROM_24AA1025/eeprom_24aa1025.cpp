@@ -22,13 +22,13 @@
  */
 #include "eeprom_24aa1025.h"
 
-#include <TwiMaster.h>
+#include <TwoWireBase.h>
 
 //TwiMaster my_twi;
 
 #define EEPROM_ID_PREFIX B1010
 
-TwiMaster* my_twi = NULL;
+TwoWireBase* my_twi = NULL;
 
 // reverse dev offset 
 // 000 - first 'device' on 1st chip
@@ -52,8 +52,53 @@ uint8_t DEV_REVERSE_LOOKUP[] = {
 
 #define PAGE_SIZE 0x80
 
-void i2c_eeprom_init(TwiMaster* twi) {
+// each chip keeps a single internal address pointer, which it leaves one past the
+// last byte read or written, in whichever block was last addressed.  we track it here,
+// so that a read at that address can be a "current address read", without sending
+// the address again.  the block select bit comes from each control byte, so the
+// pointer is only good for reads from the same block it was left in.
+// (indexed by the chip select bits of dev_id, i.e., the low 2 bits)
+static uint16_t chip_addr_ptr[4] = { 0 };
+// dev_id (so, block) that each chip's address pointer was left in
+static uint8_t  chip_addr_dev_id[4] = { 0 };
+// bit n is set if chip_addr_ptr[n] is known to match the chip
+static uint8_t  chip_addr_valid = 0;
+
+static void set_addr_ptr(uint8_t dev_id, uint16_t eeaddress) {
+  chip_addr_ptr[dev_id & 0x03]    = eeaddress;
+  chip_addr_dev_id[dev_id & 0x03] = dev_id;
+  chip_addr_valid |= (1 << (dev_id & 0x03));
+}
+
+static void forget_addr_ptr(uint8_t dev_id) {
+  chip_addr_valid &= ~(1 << (dev_id & 0x03));
+}
+
+static bool addr_ptr_is(uint8_t dev_id, uint16_t eeaddress) {
+  return (chip_addr_valid & (1 << (dev_id & 0x03)))
+    && chip_addr_dev_id[dev_id & 0x03] == dev_id
+    && chip_addr_ptr[dev_id & 0x03] == eeaddress;
+}
+
+// address the device for reading from eeaddress
+// if the device's address pointer is already there, this is just a start for reading,
+// otherwise it is a start for writing, the two address bytes, and a repeated start for reading
+static bool start_read(uint8_t dev_id, uint16_t eeaddress) {
+  if (addr_ptr_is(dev_id, eeaddress)) {
+    return my_twi->start(dev_id, I2C_READ);
+  }
+  if (my_twi->start(dev_id, I2C_WRITE)) {
+    my_twi->write((uint8_t)((eeaddress >> 8) &0xFF));
+    my_twi->write((uint8_t)(eeaddress & 0xFF));
+    return my_twi->start(dev_id, I2C_READ);
+  }
+  return false;
+}
+
+void i2c_eeprom_init(TwoWireBase* twi) {
   my_twi = twi;
+  // we don't know where any of the address pointers are
+  chip_addr_valid = 0;
 }
 
 bool i2c_eeprom_erase() {
@@ -185,25 +230,45 @@ bool i2c_eeprom_write_page(uint8_t dev_id, uint16_t eeaddress, uint8_t* data, ui
     };
     my_twi->stop();
 
+    // the address pointer only increments within the page, and rolls over to the start of it
+    set_addr_ptr(dev_id, (eeaddress & ~(PAGE_SIZE - 1)) | ((eeaddress + length) & (PAGE_SIZE - 1)));
     return true;
   } 
   else {
 //    Serial.println("nack for dev_id / write");
+    forget_addr_ptr(dev_id);
     return false;
   }
 }
 
 uint8_t i2c_eeprom_read_byte(uint8_t dev_id, uint16_t eeaddress ) {
   uint8_t b = 0;
-  if (my_twi->start(dev_id, I2C_WRITE)) {
-    my_twi->write((uint8_t)((eeaddress >> 8) &0xFF));
-    my_twi->write((uint8_t)(eeaddress & 0xFF));
-    my_twi->start(dev_id, I2C_READ);
+  if (start_read(dev_id, eeaddress)) {
     b = my_twi->read(true);
     my_twi->stop();
+    set_addr_ptr(dev_id, eeaddress + 1);
   } 
   else {
-//    Serial.println("nack for dev_id / write");
+//    Serial.println("nack for dev_id / read");
+    forget_addr_ptr(dev_id);
+  } 
+  return b;
+}
+
+uint8_t i2c_eeprom_read_next(uint8_t dev_id) {
+  uint8_t b = 0;
+  if (my_twi->start(dev_id, I2C_READ)) {
+    b = my_twi->read(true);
+    my_twi->stop();
+    // the chip read from its one pointer, whichever block it was left in,
+    // and the pointer now belongs to this block
+    if (chip_addr_valid & (1 << (dev_id & 0x03))) {
+      set_addr_ptr(dev_id, chip_addr_ptr[dev_id & 0x03] + 1);
+    }
+  } 
+  else {
+//    Serial.println("nack for dev_id / read");
+    forget_addr_ptr(dev_id);
   } 
   return b;
 }
@@ -259,20 +324,19 @@ bool i2c_eeprom_read_buffer(uint32_t address, uint8_t* data, uint32_t length) {
 }
 
 bool i2c_eeprom_read_buffer(uint8_t dev_id, uint16_t address, uint8_t *buffer, uint16_t length ) {
-  uint8_t i = 0;
-  if (my_twi->start(dev_id, I2C_WRITE)) {
-    my_twi->write((uint8_t)((address >> 8) &0xFF));
-    my_twi->write((uint8_t)(address & 0xFF));
-    my_twi->start(dev_id, I2C_READ);
+  uint16_t i = 0;
+  if (start_read(dev_id, address)) {
     while (i < length-1) {
       buffer[i++] = my_twi->read(false);
     }
     buffer[i] = my_twi->read(true);
     my_twi->stop();
+    set_addr_ptr(dev_id, address + length);
     return true;
   } 
   else {
-//    Serial.println("nack for dev_id / write");
+//    Serial.println("nack for dev_id / read");
+    forget_addr_ptr(dev_id);
     return false;
   } 
 }
@@ -23,9 +23,9 @@
 
 #include <stdint.h>
 
-class TwiMaster;
+class TwoWireBase;
 
-void i2c_eeprom_init(TwiMaster* twi);
+void i2c_eeprom_init(TwoWireBase* twi);
 bool i2c_eeprom_erase();
 bool i2c_eeprom_write_buffer(uint32_t address, uint8_t* data, uint32_t length);
 bool i2c_eeprom_write_buffer(uint8_t dev_id, uint16_t address, uint8_t* data, uint16_t length);
@@ -33,6 +33,12 @@ bool i2c_eeprom_write_buffer(uint8_t dev_id, uint16_t address, uint8_t* data, ui
 // we may need to do some internal smarts here to determine page boundaries and break up write operations
 bool i2c_eeprom_write_page(uint8_t dev_id, uint16_t eeaddress, uint8_t* data, uint8_t length );
 
+// reads are "current address reads" (no address bytes sent) when the chip's
+// internal address pointer is already at the requested address in the same block,
+// e.g. reading forward one byte at a time
 uint8_t i2c_eeprom_read_byte(uint8_t dev_id, uint16_t eeaddress);
+// read the byte at the chip's internal address pointer (one past the last byte read or written,
+// in whichever block), from the block selected by dev_id
+uint8_t i2c_eeprom_read_next(uint8_t dev_id);
 bool i2c_eeprom_read_buffer(uint32_t address, uint8_t* data, uint32_t length);
 bool i2c_eeprom_read_buffer(uint8_t dev_id, uint16_t address, uint8_t *buffer, uint16_t length); 
@@ -0,0 +1,441 @@
+/* Arduino SoftI2cMaster Library
+ *
+ * This file is part of the Arduino SoftI2cMaster and TwiMaster Libraries
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino SoftI2cMaster and TwiMaster Libraries.
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOFT_I2C_MASTER_H
+#define SOFT_I2C_MASTER_H
+#include <avr/io.h>
+#include <util/delay_basic.h>
+#include <TwoWireBase.h>
+
+// Bit-banged I2C master on any two digital pins.
+//
+// The pins are template parameters, so every pin access is a single sbi, cbi,
+// sbic or sbis instruction on the pin's DDR/PIN register.  That needs the
+// registers in the low I/O space, which holds for every pin on the 168/328 and
+// the Sanguino, but not for ports H, J, K and L on the Mega: pins on those
+// ports can't be used (the build fails with an operand out of range error).
+//
+// Lines are driven open drain: a line is pulled low by making it an output
+// (PORT bit is always 0), and released by making it an input, so external
+// pull-up resistors are required (the internal pull-ups are far too weak for
+// 400 kHz).
+//
+// The slave may stretch the clock: after releasing SCL the master waits for it
+// to actually go high before continuing, for up to SOFT_I2C_STRETCH_LOOPS.  If
+// SCL stays low (a slave holding it, or a missing pull-up), start() and write()
+// return 0, as for a Nak.
+//
+// Each byte, with its Ack bit, is clocked by a loop in inline assembly, so its
+// timing depends only on instruction cycle counts, not on the compiler.  With
+// a fast enough SCL rise (see below) the clock runs at:
+//   16 MHz: 400 kHz (27 cycles low, 13 high)
+//   20 MHz: 400 kHz (35 cycles low, 15 high)
+//    8 MHz: 348 kHz (14 cycles low, 9 high; the loop can't go any faster)
+// These were counted by stepping through the assembled loop, not measured on
+// a scope.  Start and stop conditions are written in C and padded generously,
+// so they take a few microseconds each.
+//
+// Example, a second bus for the EEPROM on the Sanguino's PB0/PB1:
+//   SoftI2cMaster<0, 1> eepromBus;
+//   eepromBus.init();
+//   i2c_eeprom_init(&eepromBus);
+
+//------------------------------------------------------------------------------
+// I2C fast mode timing, in CPU cycles
+
+// I2C clock in Hz, same as F_TWI for the hardware TwiMaster
+#define SOFT_I2C_CLOCK 400000L
+// nanoseconds to CPU cycles, rounded up
+#define SOFT_I2C_NS_TO_CYCLES(ns) ((F_CPU / 1000L * (ns) + 999999L) / 1000000L)
+// minimum SCL high time (and start hold, stop setup) is 0.6 us
+#define SOFT_I2C_HIGH_CYCLES SOFT_I2C_NS_TO_CYCLES(600)
+// minimum SCL low time (and bus free time) is 1.3 us
+#define SOFT_I2C_LOW_CYCLES SOFT_I2C_NS_TO_CYCLES(1300)
+// full clock period, rounded up
+#define SOFT_I2C_PERIOD_CYCLES ((F_CPU + SOFT_I2C_CLOCK - 1) / SOFT_I2C_CLOCK)
+
+// cycles taken by the instructions of one bit of the transfer loop in
+// SoftI2cMaster::transfer(), besides its two delays:
+// from SCL falling to SCL released (loop, set SDA, shift)
+#define SOFT_I2C_BIT_LOW_CODE  14
+// from SCL released to seeing it high, if it is high at the first test
+// (so this is also part of the low time, if SCL is slow to rise)
+#define SOFT_I2C_BIT_WAIT_CODE 3
+// from seeing SCL high to SCL falling (leave the wait, sample SDA, pull SCL low)
+#define SOFT_I2C_BIT_HIGH_CODE 6
+
+// delays in the transfer loop: the high time is padded up to the minimum, and
+// the low time up to its minimum, or further so a whole bit is one period
+#define SOFT_I2C_BIT_HIGH_DELAY \
+  (SOFT_I2C_HIGH_CYCLES > SOFT_I2C_BIT_HIGH_CODE ? \
+   SOFT_I2C_HIGH_CYCLES - SOFT_I2C_BIT_HIGH_CODE : 0)
+#define SOFT_I2C_BIT_CODE (SOFT_I2C_BIT_LOW_CODE + SOFT_I2C_BIT_WAIT_CODE + \
+  SOFT_I2C_BIT_HIGH_CODE + SOFT_I2C_BIT_HIGH_DELAY)
+#define SOFT_I2C_BIT_LOW_DELAY_MIN \
+  (SOFT_I2C_LOW_CYCLES > SOFT_I2C_BIT_LOW_CODE ? \
+   SOFT_I2C_LOW_CYCLES - SOFT_I2C_BIT_LOW_CODE : 0)
+#define SOFT_I2C_BIT_LOW_DELAY_PERIOD \
+  (SOFT_I2C_PERIOD_CYCLES > SOFT_I2C_BIT_CODE ? \
+   SOFT_I2C_PERIOD_CYCLES - SOFT_I2C_BIT_CODE : 0)
+#define SOFT_I2C_BIT_LOW_DELAY \
+  (SOFT_I2C_BIT_LOW_DELAY_MIN > SOFT_I2C_BIT_LOW_DELAY_PERIOD ? \
+   SOFT_I2C_BIT_LOW_DELAY_MIN : SOFT_I2C_BIT_LOW_DELAY_PERIOD)
+
+// how many times to test SCL while waiting for a slave to stop stretching
+// the clock, about 10 ms worth (each test takes at least 5 cycles)
+#define SOFT_I2C_STRETCH_LOOPS (F_CPU / 500L)
+
+//------------------------------------------------------------------------------
+// digital pin number to port registers and bit
+struct SoftI2cPin {
+  volatile uint8_t* ddr;
+  volatile uint8_t* pin;
+  volatile uint8_t* port;
+  uint8_t bit;
+};
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+// Mega Arduino
+static const SoftI2cPin softI2cPinMap[] = {
+  {&DDRE, &PINE, &PORTE, 0},  // D0
+  {&DDRE, &PINE, &PORTE, 1},  // D1
+  {&DDRE, &PINE, &PORTE, 4},  // D2
+  {&DDRE, &PINE, &PORTE, 5},  // D3
+  {&DDRG, &PING, &PORTG, 5},  // D4
+  {&DDRE, &PINE, &PORTE, 3},  // D5
+  {&DDRH, &PINH, &PORTH, 3},  // D6
+  {&DDRH, &PINH, &PORTH, 4},  // D7
+  {&DDRH, &PINH, &PORTH, 5},  // D8
+  {&DDRH, &PINH, &PORTH, 6},  // D9
+  {&DDRB, &PINB, &PORTB, 4},  // D10
+  {&DDRB, &PINB, &PORTB, 5},  // D11
+  {&DDRB, &PINB, &PORTB, 6},  // D12
+  {&DDRB, &PINB, &PORTB, 7},  // D13
+  {&DDRJ, &PINJ, &PORTJ, 1},  // D14
+  {&DDRJ, &PINJ, &PORTJ, 0},  // D15
+  {&DDRH, &PINH, &PORTH, 1},  // D16
+  {&DDRH, &PINH, &PORTH, 0},  // D17
+  {&DDRD, &PIND, &PORTD, 3},  // D18
+  {&DDRD, &PIND, &PORTD, 2},  // D19
+  {&DDRD, &PIND, &PORTD, 1},  // D20
+  {&DDRD, &PIND, &PORTD, 0},  // D21
+  {&DDRA, &PINA, &PORTA, 0},  // D22
+  {&DDRA, &PINA, &PORTA, 1},  // D23
+  {&DDRA, &PINA, &PORTA, 2},  // D24
+  {&DDRA, &PINA, &PORTA, 3},  // D25
+  {&DDRA, &PINA, &PORTA, 4},  // D26
+  {&DDRA, &PINA, &PORTA, 5},  // D27
+  {&DDRA, &PINA, &PORTA, 6},  // D28
+  {&DDRA, &PINA, &PORTA, 7},  // D29
+  {&DDRC, &PINC, &PORTC, 7},  // D30
+  {&DDRC, &PINC, &PORTC, 6},  // D31
+  {&DDRC, &PINC, &PORTC, 5},  // D32
+  {&DDRC, &PINC, &PORTC, 4},  // D33
+  {&DDRC, &PINC, &PORTC, 3},  // D34
+  {&DDRC, &PINC, &PORTC, 2},  // D35
+  {&DDRC, &PINC, &PORTC, 1},  // D36
+  {&DDRC, &PINC, &PORTC, 0},  // D37
+  {&DDRD, &PIND, &PORTD, 7},  // D38
+  {&DDRG, &PING, &PORTG, 2},  // D39
+  {&DDRG, &PING, &PORTG, 1},  // D40
+  {&DDRG, &PING, &PORTG, 0},  // D41
+  {&DDRL, &PINL, &PORTL, 7},  // D42
+  {&DDRL, &PINL, &PORTL, 6},  // D43
+  {&DDRL, &PINL, &PORTL, 5},  // D44
+  {&DDRL, &PINL, &PORTL, 4},  // D45
+  {&DDRL, &PINL, &PORTL, 3},  // D46
+  {&DDRL, &PINL, &PORTL, 2},  // D47
+  {&DDRL, &PINL, &PORTL, 1},  // D48
+  {&DDRL, &PINL, &PORTL, 0},  // D49
+  {&DDRB, &PINB, &PORTB, 3},  // D50
+  {&DDRB, &PINB, &PORTB, 2},  // D51
+  {&DDRB, &PINB, &PORTB, 1},  // D52
+  {&DDRB, &PINB, &PORTB, 0},  // D53
+  {&DDRF, &PINF, &PORTF, 0},  // D54
+  {&DDRF, &PINF, &PORTF, 1},  // D55
+  {&DDRF, &PINF, &PORTF, 2},  // D56
+  {&DDRF, &PINF, &PORTF, 3},  // D57
+  {&DDRF, &PINF, &PORTF, 4},  // D58
+  {&DDRF, &PINF, &PORTF, 5},  // D59
+  {&DDRF, &PINF, &PORTF, 6},  // D60
+  {&DDRF, &PINF, &PORTF, 7},  // D61
+  {&DDRK, &PINK, &PORTK, 0},  // D62
+  {&DDRK, &PINK, &PORTK, 1},  // D63
+  {&DDRK, &PINK, &PORTK, 2},  // D64
+  {&DDRK, &PINK, &PORTK, 3},  // D65
+  {&DDRK, &PINK, &PORTK, 4},  // D66
+  {&DDRK, &PINK, &PORTK, 5},  // D67
+  {&DDRK, &PINK, &PORTK, 6},  // D68
+  {&DDRK, &PINK, &PORTK, 7}   // D69
+};
+#elif defined(__AVR_ATmega644P__) || defined(__AVR_ATmega644__)
+// Sanguino
+static const SoftI2cPin softI2cPinMap[] = {
+  {&DDRB, &PINB, &PORTB, 0},  // D0
+  {&DDRB, &PINB, &PORTB, 1},  // D1
+  {&DDRB, &PINB, &PORTB, 2},  // D2
+  {&DDRB, &PINB, &PORTB, 3},  // D3
+  {&DDRB, &PINB, &PORTB, 4},  // D4
+  {&DDRB, &PINB, &PORTB, 5},  // D5
+  {&DDRB, &PINB, &PORTB, 6},  // D6
+  {&DDRB, &PINB, &PORTB, 7},  // D7
+  {&DDRD, &PIND, &PORTD, 0},  // D8
+  {&DDRD, &PIND, &PORTD, 1},  // D9
+  {&DDRD, &PIND, &PORTD, 2},  // D10
+  {&DDRD, &PIND, &PORTD, 3},  // D11
+  {&DDRD, &PIND, &PORTD, 4},  // D12
+  {&DDRD, &PIND, &PORTD, 5},  // D13
+  {&DDRD, &PIND, &PORTD, 6},  // D14
+  {&DDRD, &PIND, &PORTD, 7},  // D15
+  {&DDRC, &PINC, &PORTC, 0},  // D16
+  {&DDRC, &PINC, &PORTC, 1},  // D17
+  {&DDRC, &PINC, &PORTC, 2},  // D18
+  {&DDRC, &PINC, &PORTC, 3},  // D19
+  {&DDRC, &PINC, &PORTC, 4},  // D20
+  {&DDRC, &PINC, &PORTC, 5},  // D21
+  {&DDRC, &PINC, &PORTC, 6},  // D22
+  {&DDRC, &PINC, &PORTC, 7},  // D23
+  {&DDRA, &PINA, &PORTA, 7},  // D24
+  {&DDRA, &PINA, &PORTA, 6},  // D25
+  {&DDRA, &PINA, &PORTA, 5},  // D26
+  {&DDRA, &PINA, &PORTA, 4},  // D27
+  {&DDRA, &PINA, &PORTA, 3},  // D28
+  {&DDRA, &PINA, &PORTA, 2},  // D29
+  {&DDRA, &PINA, &PORTA, 1},  // D30
+  {&DDRA, &PINA, &PORTA, 0}   // D31
+};
+#else // __AVR_ATmega1280__
+// all other Arduinos (atmega168/328)
+static const SoftI2cPin softI2cPinMap[] = {
+  {&DDRD, &PIND, &PORTD, 0},  // D0
+  {&DDRD, &PIND, &PORTD, 1},  // D1
+  {&DDRD, &PIND, &PORTD, 2},  // D2
+  {&DDRD, &PIND, &PORTD, 3},  // D3
+  {&DDRD, &PIND, &PORTD, 4},  // D4
+  {&DDRD, &PIND, &PORTD, 5},  // D5
+  {&DDRD, &PIND, &PORTD, 6},  // D6
+  {&DDRD, &PIND, &PORTD, 7},  // D7
+  {&DDRB, &PINB, &PORTB, 0},  // D8
+  {&DDRB, &PINB, &PORTB, 1},  // D9
+  {&DDRB, &PINB, &PORTB, 2},  // D10
+  {&DDRB, &PINB, &PORTB, 3},  // D11
+  {&DDRB, &PINB, &PORTB, 4},  // D12
+  {&DDRB, &PINB, &PORTB, 5},  // D13
+  {&DDRC, &PINC, &PORTC, 0},  // D14
+  {&DDRC, &PINC, &PORTC, 1},  // D15
+  {&DDRC, &PINC, &PORTC, 2},  // D16
+  {&DDRC, &PINC, &PORTC, 3},  // D17
+  {&DDRC, &PINC, &PORTC, 4},  // D18
+  {&DDRC, &PINC, &PORTC, 5}   // D19
+};
+#endif // __AVR_ATmega1280__
+
+//------------------------------------------------------------------------------
+// delay for at least the given number of cycles.
+// this is a compile time constant, so it reduces to a short fixed loop or nothing.
+static inline void softI2cDelay(uint16_t cycles)
+  __attribute__((always_inline));
+static inline void softI2cDelay(uint16_t cycles)
+{
+  // _delay_loop_1 takes three cycles per count, so round up
+  if (cycles > 0) _delay_loop_1((cycles + 2) / 3);
+}
+
+// I/O address (for sbi/cbi/sbic/sbis) of a register; a constant, once the pin map is folded in
+#define SOFT_I2C_IO(reg) ((uint8_t)((uintptr_t)(reg) - __SFR_OFFSET))
+
+// assembler for a delay of exactly k*3 + r cycles (k from 0 to 255, r from 0 to 2),
+// using the %[tmp] operand as a counter
+#define SOFT_I2C_ASM_DELAY(k, r, label) \
+  ".if " k "\n\t"                       \
+  "ldi %[tmp], " k "\n"                 \
+  label ":\n\t"                         \
+  "dec %[tmp]\n\t"                      \
+  "brne " label "b\n\t"                 \
+  ".endif\n\t"                          \
+  ".rept " r "\n\t"                     \
+  "nop\n\t"                             \
+  ".endr\n\t"
+
+//------------------------------------------------------------------------------
+template<uint8_t sclPin, uint8_t sdaPin>
+class SoftI2cMaster : public TwoWireBase {
+  // pull a line low, or release it to be pulled high
+  static void sclLow(void) __attribute__((always_inline)) {
+    *softI2cPinMap[sclPin].ddr |= (1 << softI2cPinMap[sclPin].bit);
+  }
+  static void sclRelease(void) __attribute__((always_inline)) {
+    *softI2cPinMap[sclPin].ddr &= ~(1 << softI2cPinMap[sclPin].bit);
+  }
+  static void sdaLow(void) __attribute__((always_inline)) {
+    *softI2cPinMap[sdaPin].ddr |= (1 << softI2cPinMap[sdaPin].bit);
+  }
+  static void sdaRelease(void) __attribute__((always_inline)) {
+    *softI2cPinMap[sdaPin].ddr &= ~(1 << softI2cPinMap[sdaPin].bit);
+  }
+
+  static uint8_t sclRead(void) __attribute__((always_inline)) {
+    return *softI2cPinMap[sclPin].pin & (1 << softI2cPinMap[sclPin].bit);
+  }
+
+  // release SCL, and wait for any clock stretching by the slave
+  // returns false if SCL is still low after SOFT_I2C_STRETCH_LOOPS tests
+  static uint8_t sclHigh(void) __attribute__((always_inline)) {
+    sclRelease();
+    for (uint16_t n = SOFT_I2C_STRETCH_LOOPS; n != 0; n--) {
+      if (sclRead()) return true;
+    }
+    return false;
+  }
+
+  // clock nine bits (a byte and its Ack bit), starting and ending with SCL low.
+  // out holds the bits to send in its top nine bits: for a 1 SDA is released,
+  // for a 0 it's pulled low.  the nine bits sampled from SDA while SCL is high
+  // are returned in the low nine bits of in.
+  // returns false if the slave held SCL low for too long.
+  //
+  // the cycle counts in the comments are what SOFT_I2C_BIT_*_CODE are made of;
+  // keep them in step.
+  static uint8_t transfer(uint16_t out, uint16_t* in) __attribute__((always_inline)) {
+    uint8_t  bits;
+    uint8_t  tmp;
+    uint16_t wait;
+    uint16_t sampled = 0;
+    __asm__ __volatile__(
+      "ldi %[bits], 9\n"
+      "1:\n\t"
+      // set SDA from the top bit of out: 5 cycles either way
+      "sbrc %B[out], 7\n\t"
+      "cbi %[sdaDdr], %[sdaBit]\n\t"
+      "sbrs %B[out], 7\n\t"
+      "sbi %[sdaDdr], %[sdaBit]\n\t"
+      // next bit out, and make room for the next bit in: 4 cycles
+      "lsl %A[out]\n\t"
+      "rol %B[out]\n\t"
+      "lsl %A[in]\n\t"
+      "rol %B[in]\n\t"
+      SOFT_I2C_ASM_DELAY("%[lowK]", "%[lowR]", "2")
+      // release SCL: 2 cycles
+      "cbi %[sclDdr], %[sclBit]\n\t"
+      // wait for SCL to go high: 3 cycles (ldi, ldi, sbic) if it already is
+      "ldi %A[wait], lo8(%[stretch])\n\t"
+      "ldi %B[wait], hi8(%[stretch])\n"
+      "3:\n\t"
+      "sbic %[sclPin], %[sclBit]\n\t"
+      "rjmp 4f\n\t"
+      "sbiw %[wait], 1\n\t"
+      "brne 3b\n\t"
+      "rjmp 5f\n"
+      // SCL is high: 2 cycles to get here
+      "4:\n\t"
+      SOFT_I2C_ASM_DELAY("%[highK]", "%[highR]", "6")
+      // sample SDA: 2 cycles either way
+      "sbic %[sdaPin], %[sdaBit]\n\t"
+      "ori %A[in], 1\n\t"
+      // pull SCL low: 2 cycles
+      "sbi %[sclDdr], %[sclBit]\n\t"
+      // next bit: 3 cycles (counted in the low time)
+      "dec %[bits]\n\t"
+      "brne 1b\n"
+      "5:\n\t"
+      : [bits] "=&d" (bits),
+        [tmp] "=&d" (tmp),
+        [wait] "=&w" (wait),
+        [out] "+r" (out),
+        [in] "+d" (sampled)
+      : [sclDdr] "I" (SOFT_I2C_IO(softI2cPinMap[sclPin].ddr)),
+        [sclPin] "I" (SOFT_I2C_IO(softI2cPinMap[sclPin].pin)),
+        [sclBit] "I" (softI2cPinMap[sclPin].bit),
+        [sdaDdr] "I" (SOFT_I2C_IO(softI2cPinMap[sdaPin].ddr)),
+        [sdaPin] "I" (SOFT_I2C_IO(softI2cPinMap[sdaPin].pin)),
+        [sdaBit] "I" (softI2cPinMap[sdaPin].bit),
+        [stretch] "i" (SOFT_I2C_STRETCH_LOOPS),
+        [lowK] "M" (SOFT_I2C_BIT_LOW_DELAY / 3),
+        [lowR] "M" (SOFT_I2C_BIT_LOW_DELAY % 3),
+        [highK] "M" (SOFT_I2C_BIT_HIGH_DELAY / 3),
+        [highR] "M" (SOFT_I2C_BIT_HIGH_DELAY % 3)
+    );
+    *in = sampled;
+    // the loop counts bits down to zero, unless it gave up waiting for SCL
+    return bits == 0;
+  }
+public:
+  /** init pins: both lines released, and never driven high */
+  void init(void) {
+    sclRelease();
+    sdaRelease();
+    // clear PORT bits so the pins are pulled low, not high, when they are outputs
+    *softI2cPinMap[sclPin].port &= ~(1 << softI2cPinMap[sclPin].bit);
+    *softI2cPinMap[sdaPin].port &= ~(1 << softI2cPinMap[sdaPin].bit);
+  }
+
+  /** read a byte and send Ack if last is false else Nak to terminate read
+   * (if the slave holds SCL low for too long, the byte is incomplete) */
+  uint8_t read(uint8_t last) {
+    uint16_t in;
+    // release SDA for the eight data bits, then Ack (low) or Nak (released)
+    transfer(last ? 0xFF80 : 0xFF00, &in);
+    sdaRelease();
+    return in >> 1;
+  }
+
+  /** send new address and read/write bit without stop */
+  uint8_t restart(uint8_t addressRW) {return start(addressRW);}
+  uint8_t restart(uint8_t address, uint8_t rw) {return restart((address << 1) | rw); }
+
+  /** issue a start condition for i2c address with read/write bit */
+  uint8_t start(uint8_t addressRW) {
+    // SCL may still be low after a previous transfer, so release both lines
+    // first; this makes the same code a repeated start
+    sdaRelease();
+    softI2cDelay(SOFT_I2C_LOW_CYCLES);
+    if (!sclHigh()) return 0;
+    softI2cDelay(SOFT_I2C_HIGH_CYCLES);
+    // SDA falling while SCL is high
+    sdaLow();
+    softI2cDelay(SOFT_I2C_HIGH_CYCLES);
+    sclLow();
+    return write(addressRW);
+  }
+  uint8_t start(uint8_t address, uint8_t rw) {return start((address << 1) | rw); }
+
+  /** issue a stop condition */
+  void stop(void) {
+    sdaLow();
+    softI2cDelay(SOFT_I2C_LOW_CYCLES);
+    // if SCL is stuck low there is no stop to be had, but release SDA anyway
+    sclHigh();
+    softI2cDelay(SOFT_I2C_HIGH_CYCLES);
+    // SDA rising while SCL is high
+    sdaRelease();
+    softI2cDelay(SOFT_I2C_LOW_CYCLES);
+  }
+
+  /** write a byte and return true for Ack or false for Nak (or a stuck clock) */
+  uint8_t write(uint8_t data) {
+    uint16_t in;
+    // the data bits, then release SDA so the slave can pull it low to Ack
+    if (!transfer(((uint16_t)data << 8) | 0x80, &in)) {
+      sdaRelease();
+      return 0;
+    }
+    return (in & 1) == 0;
+  }
+};
+
+#endif // SOFT_I2C_MASTER_H
@@ -0,0 +1,271 @@
+// implementation of the stub Arduino core and libraries declared in stubs/
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <LiquidCrystal.h>
+#include <Twitter.h>
+#include <utility/w5100.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+uint32_t simMillis = 0;
+uint8_t  pinLevel[NUM_DIGITAL_PINS] = { 0 };
+uint16_t mpdPort = 6600;
+bool     echoSerial = false;
+
+uint32_t lcdDataBytes = 0;
+uint32_t lcdCommandBytes = 0;
+
+uint32_t mpdBytesWritten = 0;
+uint32_t mpdBytesRead = 0;
+uint32_t mpdBytesDiscarded = 0;
+uint32_t mpdConnects = 0;
+
+uint32_t serialBytes = 0;
+uint32_t tweets = 0;
+
+HardwareSerial Serial;
+EthernetClass Ethernet;
+W5100Class W5100;
+
+uint64_t nowNanos(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+// core
+uint32_t millis(void) {
+  return simMillis;
+}
+
+// delay() really sleeps as well as advancing the simulated clock,
+// so the sketch waits on the fake server like it would on the real one
+void delay(uint32_t ms) {
+  simMillis += ms;
+  usleep(ms * 1000);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < NUM_DIGITAL_PINS) {
+    pinLevel[pin] = val ? HIGH : LOW;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? pinLevel[pin] : LOW;
+}
+
+//------------------------------------------------------------------------------
+// Print
+void Print::write(const char* str) {
+  while (*str) {
+    write((uint8_t)*str++);
+  }
+}
+
+void Print::write(const uint8_t* buf, size_t size) {
+  while (size--) {
+    write(*buf++);
+  }
+}
+
+void Print::print(const char* str) { write(str); }
+void Print::print(char c) { write((uint8_t)c); }
+void Print::print(int n, int base) { print((long)n, base); }
+void Print::print(unsigned int n, int base) { print((unsigned long)n, base); }
+
+void Print::print(long n, int base) {
+  if (n < 0 && base == DEC) {
+    print('-');
+    n = -n;
+  }
+  print((unsigned long)n, base);
+}
+
+void Print::print(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do {
+    unsigned long m = n;
+    n /= base;
+    char c = m - base * n;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  write(str);
+}
+
+// like the Arduino core, println ends lines with "\r\n"
+void Print::println(void) { write("\r\n"); }
+void Print::println(const char* str) { print(str); println(); }
+void Print::println(char c) { print(c); println(); }
+void Print::println(int n, int base) { print(n, base); println(); }
+void Print::println(unsigned int n, int base) { print(n, base); println(); }
+void Print::println(long n, int base) { print(n, base); println(); }
+void Print::println(unsigned long n, int base) { print(n, base); println(); }
+
+//------------------------------------------------------------------------------
+// Serial
+void HardwareSerial::begin(long baud) {
+}
+
+void HardwareSerial::write(uint8_t c) {
+  serialBytes++;
+  if (echoSerial) {
+    fputc(c, stderr);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Twitter
+bool Twitter::post(const char* msg) {
+  tweets++;
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// LiquidCrystal
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t enable,
+                             uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+  : cols_(16), lines_(2), row_(0), col_(0) {
+  memset(screen, ' ', sizeof(screen));
+  for (uint8_t i = 0; i < LCD_MAX_LINES; i++) {
+    screen[i][LCD_MAX_COLUMNS] = '\0';
+  }
+}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t lines) {
+  cols_  = min(cols, LCD_MAX_COLUMNS);
+  lines_ = min(lines, LCD_MAX_LINES);
+  for (uint8_t i = 0; i < LCD_MAX_LINES; i++) {
+    screen[i][cols_] = '\0';
+  }
+  clear();
+}
+
+void LiquidCrystal::clear(void) {
+  lcdCommandBytes++;
+  for (uint8_t i = 0; i < lines_; i++) {
+    memset(screen[i], ' ', cols_);
+  }
+  row_ = 0;
+  col_ = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  lcdCommandBytes++;
+  row_ = min(row, (uint8_t)(lines_ - 1));
+  col_ = col;
+}
+
+void LiquidCrystal::write(uint8_t c) {
+  lcdDataBytes++;
+  if (col_ < cols_) {
+    screen[row_][col_] = c;
+  }
+  col_++;
+}
+
+//------------------------------------------------------------------------------
+// Client
+uint8_t Client::connect(void) {
+  stop();
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(mpdPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    stop();
+    return false;
+  }
+  // the W5100 sends each write as soon as it's made, so don't let Nagle batch them up
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  mpdConnects++;
+  return true;
+}
+
+// like the Arduino Client, we're still "connected" while there's unread data,
+// even if the other end has closed
+uint8_t Client::connected(void) {
+  if (fd_ < 0) {
+    return false;
+  }
+  char c;
+  ssize_t n = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) {
+    return true;
+  }
+  if (n == 0) {
+    return false;
+  }
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int Client::available(void) {
+  int n = 0;
+  if (fd_ < 0 || ioctl(fd_, FIONREAD, &n) < 0) {
+    return 0;
+  }
+  return n;
+}
+
+int Client::read(void) {
+  uint8_t c;
+  if (fd_ < 0 || recv(fd_, &c, 1, MSG_DONTWAIT) != 1) {
+    return -1;
+  }
+  mpdBytesRead++;
+  return c;
+}
+
+void Client::flush(void) {
+  char buf[256];
+  int n;
+  while (available() > 0 && (n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    mpdBytesDiscarded += n;
+  }
+}
+
+void Client::stop(void) {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void Client::write(uint8_t c) {
+  write(&c, 1);
+}
+
+void Client::write(const char* str) {
+  write((const uint8_t*)str, strlen(str));
+}
+
+void Client::write(const uint8_t* buf, size_t size) {
+  if (fd_ < 0 || size == 0) {
+    return;
+  }
+  ssize_t n = send(fd_, buf, size, MSG_NOSIGNAL);
+  if (n > 0) {
+    mpdBytesWritten += n;
+  }
+}
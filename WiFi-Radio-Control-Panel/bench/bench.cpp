@@ -0,0 +1,244 @@
+// host-side bench for the control panel sketch.
+//
+// builds control_panel.pde against the stub Arduino core in stubs/, starts a
+// fake MPD server in a child process, then runs setup() and loop() on a
+// simulated clock while turning the dial through the stations on a schedule.
+// at the end it reports:
+//  - how long each pass through loop() took (wall clock)
+//  - how many bytes per (simulated) second were sent to the LCD
+//  - how many bytes were read from MPD, and how many were thrown away unread
+//  - how long from turning the dial until MPD was told to play (simulated,
+//    and wall clock as seen by the server), how long the loop() pass that
+//    switched stations took, and how many responses MPD sent during it
+//
+// usage: bench [--seconds N] [--switch-every N] [--tick MS] [--drop-after N] [--verbose]
+// the standard library has to come before Arduino.h, which defines min and max as macros
+#include <algorithm>
+#include <vector>
+
+#include <Arduino.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// the sketch's entry points
+void setup(void);
+void loop(void);
+
+// the rotary encoder pins, as wired in the sketch
+// (these must be kept in sync with ENC_BIT_* in control_panel.pde)
+#define ENC_BIT_0 14
+#define ENC_BIT_1 15
+#define ENC_BIT_2 16
+#define ENC_BIT_3 17
+
+// the stations the bench cycles through (skipping "Stop", which never plays)
+// (these must be kept in sync with the stations[] that have urls in control_panel.pde)
+#define FIRST_STATION 1
+#define LAST_STATION  6
+
+// the encoder pulls its pins low, so the sketch inverts them when it reads them
+static void setDial(uint8_t value) {
+  pinLevel[ENC_BIT_0] = (value & 0x1) ? LOW : HIGH;
+  pinLevel[ENC_BIT_1] = (value & 0x2) ? LOW : HIGH;
+  pinLevel[ENC_BIT_2] = (value & 0x4) ? LOW : HIGH;
+  pinLevel[ENC_BIT_3] = (value & 0x8) ? LOW : HIGH;
+}
+
+// value at the given percentile of sorted samples
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double pct) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t i = (size_t)(pct / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+static double mean(const std::vector<uint64_t>& samples) {
+  if (samples.empty()) {
+    return 0;
+  }
+  double total = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    total += samples[i];
+  }
+  return total / samples.size();
+}
+
+// print the distribution of samples, scaled down by divisor, in the given units
+static void printDistribution(const char* name, std::vector<uint64_t> samples,
+                              double divisor, const char* units) {
+  std::sort(samples.begin(), samples.end());
+  printf("%-28s n=%-7lu mean=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f %s\n",
+         name, (unsigned long)samples.size(),
+         mean(samples) / divisor,
+         percentile(samples, 50) / divisor,
+         percentile(samples, 90) / divisor,
+         percentile(samples, 99) / divisor,
+         (samples.empty() ? 0 : samples.back()) / divisor,
+         units);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [--seconds N] [--switch-every N] [--tick MS] [--drop-after N] [--verbose]\n", name);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  // how long to run, in simulated seconds
+  uint32_t seconds = 60;
+  // how often to turn the dial, in simulated seconds
+  uint32_t switchEvery = 10;
+  // how far to advance the simulated clock on each pass through loop()
+  uint32_t tick = 1;
+  // if nonzero, the fake server drops the connection after this many commands
+  uint32_t dropAfter = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--switch-every") == 0 && i + 1 < argc) {
+      switchEvery = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+      tick = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--drop-after") == 0 && i + 1 < argc) {
+      dropAfter = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      echoSerial = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (seconds == 0 || switchEvery == 0 || tick == 0) {
+    usage(argv[0]);
+  }
+
+  // listen on any free port on the loopback interface
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = 0;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  if (listenFd < 0
+      || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+      || listen(listenFd, 1) < 0
+      || getsockname(listenFd, (struct sockaddr*)&addr, &addrLen) < 0) {
+    perror("bench: listen");
+    return 1;
+  }
+  mpdPort = ntohs(addr.sin_port);
+
+  int events[2];
+  if (pipe(events) < 0) {
+    perror("bench: pipe");
+    return 1;
+  }
+
+  pid_t server = fork();
+  if (server < 0) {
+    perror("bench: fork");
+    return 1;
+  }
+  if (server == 0) {
+    close(events[0]);
+    fakeMpdServe(listenFd, events[1], dropAfter);
+    _exit(0);
+  }
+  close(listenFd);
+  close(events[1]);
+  fcntl(events[0], F_SETFL, O_NONBLOCK);
+
+  setup();
+
+  // measurements
+  std::vector<uint64_t> loopNanos;
+  std::vector<uint64_t> dialToPlayMillis;
+  std::vector<uint64_t> dialToPlayNanos;
+  std::vector<uint64_t> switchLoopNanos;
+  std::vector<uint64_t> switchResponses;
+  uint32_t lcdBytesAtStart = lcdDataBytes + lcdCommandBytes;
+  uint32_t startMillis     = simMillis;
+
+  uint32_t endMillis     = startMillis + seconds * 1000;
+  uint32_t nextSwitch    = startMillis;
+  uint8_t  station       = LAST_STATION;
+  uint32_t dialMillis    = 0;
+  uint64_t dialNanos     = 0;
+  bool     dialPending   = false;
+  uint32_t responses     = 0;
+
+  while (simMillis < endMillis) {
+    if (simMillis >= nextSwitch) {
+      station = station >= LAST_STATION ? FIRST_STATION : station + 1;
+      setDial(station);
+      dialMillis  = simMillis;
+      dialNanos   = nowNanos();
+      dialPending = true;
+      nextSwitch += switchEvery * 1000;
+    }
+
+    uint64_t start = nowNanos();
+    loop();
+    uint64_t end = nowNanos();
+    loopNanos.push_back(end - start);
+
+    // see what the server did during this pass
+    uint32_t responsesThisLoop = 0;
+    bool played = false;
+    uint64_t playNanos = 0;
+    MpdEvent event;
+    while (read(events[0], &event, sizeof(event)) == sizeof(event)) {
+      if (event.type == MPD_EVENT_RESPONSE) {
+        responsesThisLoop++;
+      } else if (event.type == MPD_EVENT_PLAY) {
+        played    = true;
+        playNanos = event.nanos;
+      }
+    }
+    responses += responsesThisLoop;
+
+    if (played && dialPending) {
+      dialToPlayMillis.push_back(simMillis - dialMillis);
+      dialToPlayNanos.push_back(playNanos - dialNanos);
+      switchLoopNanos.push_back(end - start);
+      switchResponses.push_back(responsesThisLoop);
+      dialPending = false;
+    }
+
+    simMillis += tick;
+  }
+
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+
+  double simSeconds = (simMillis - startMillis) / 1000.0;
+  uint32_t lcdBytes = lcdDataBytes + lcdCommandBytes - lcdBytesAtStart;
+
+  printf("simulated %.1f s, %lu passes through loop(), %lu station switches\n",
+         simSeconds, (unsigned long)loopNanos.size(), (unsigned long)dialToPlayMillis.size());
+  printDistribution("loop() time", loopNanos, 1000.0, "us");
+  printDistribution("dial to play", dialToPlayMillis, 1.0, "ms (simulated)");
+  printDistribution("dial to play at server", dialToPlayNanos, 1000.0, "us (wall clock)");
+  printDistribution("station switch loop() time", switchLoopNanos, 1000.0, "us");
+  printDistribution("responses per switch", switchResponses, 1.0, "");
+  printf("%-28s %.1f bytes/s (%lu data, %lu command bytes in total)\n",
+         "LCD", lcdBytes / simSeconds,
+         (unsigned long)lcdDataBytes, (unsigned long)lcdCommandBytes);
+  printf("%-28s %lu written, %lu read, %lu discarded unread, %lu responses, %lu connects\n",
+         "MPD bytes", (unsigned long)mpdBytesWritten, (unsigned long)mpdBytesRead,
+         (unsigned long)mpdBytesDiscarded, (unsigned long)responses, (unsigned long)mpdConnects);
+  printf("%-28s %lu bytes to Serial, %lu tweets\n",
+         "other", (unsigned long)serialBytes, (unsigned long)tweets);
+
+  // a panel that never managed to switch stations is a failure, not a benchmark
+  return dialToPlayMillis.empty() ? 1 : 0;
+}
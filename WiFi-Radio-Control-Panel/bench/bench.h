@@ -0,0 +1,44 @@
+// state shared between the stub Arduino core, the fake MPD server and the bench driver.
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+// simulated time, in milliseconds, returned by millis()
+extern uint32_t simMillis;
+// levels of the digital pins, as read by digitalRead()
+extern uint8_t pinLevel[];
+// port on 127.0.0.1 that Client::connect() connects to
+extern uint16_t mpdPort;
+// if true, anything the sketch prints to Serial is copied to stderr
+extern bool echoSerial;
+
+// bytes sent to the LCD: characters, and commands (clear, setCursor)
+extern uint32_t lcdDataBytes;
+extern uint32_t lcdCommandBytes;
+
+// bytes exchanged with the radio server
+extern uint32_t mpdBytesWritten;
+extern uint32_t mpdBytesRead;
+extern uint32_t mpdBytesDiscarded;
+extern uint32_t mpdConnects;
+
+extern uint32_t serialBytes;
+extern uint32_t tweets;
+
+// monotonic clock, in nanoseconds
+uint64_t nowNanos(void);
+
+// events the fake server reports to the bench over a pipe
+enum { MPD_EVENT_PLAY = 1, MPD_EVENT_RESPONSE = 2 };
+struct MpdEvent {
+  uint8_t  type;
+  uint64_t nanos;
+};
+
+// accept connections on listenFd and answer them like MPD, until killed.
+// if dropAfter is nonzero, each connection is closed after that many commands,
+// as if MPD had been restarted.
+void fakeMpdServe(int listenFd, int eventFd, uint32_t dropAfter);
+
+#endif // BENCH_H
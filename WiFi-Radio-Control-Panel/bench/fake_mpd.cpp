@@ -0,0 +1,185 @@
+// a tiny MPD look-alike for the bench.
+// it understands just the commands the control panel sends (and command lists),
+// answers them the way MPD 0.16 does, and reports each "play" and each
+// completed response to the bench over a pipe.
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+// how many currentsong requests between changes of the song title
+#define SONG_CHANGE_EVERY 4
+
+static void sendString(int fd, const char* str) {
+  send(fd, str, strlen(str), MSG_NOSIGNAL);
+}
+
+static void report(int eventFd, uint8_t type) {
+  MpdEvent event;
+  event.type  = type;
+  event.nanos = nowNanos();
+  if (write(eventFd, &event, sizeof(event)) != sizeof(event)) {
+    perror("fake mpd: event pipe");
+  }
+}
+
+// state of one client connection
+struct Session {
+  int      fd;
+  int      eventFd;
+  bool     inList;
+  bool     listOk;
+  bool     listFailed;
+  uint16_t listIndex;
+  uint32_t commands;
+  // what's on the playlist, and whether it's playing
+  char     url[256];
+  bool     playing;
+};
+
+static uint32_t songRequests = 0;
+
+// run a single command, appending its output to out.
+// returns false (with an ACK in out) if the command failed.
+static bool runCommand(Session* s, const char* line, char* out, size_t outLen) {
+  char cmd[32] = { 0 };
+  sscanf(line, "%31s", cmd);
+
+  if (strcmp(cmd, "stop") == 0) {
+    s->playing = false;
+  } else if (strcmp(cmd, "clear") == 0) {
+    s->playing = false;
+    s->url[0]  = '\0';
+  } else if (strcmp(cmd, "add") == 0) {
+    const char* arg = line + 3;
+    while (*arg == ' ') {
+      arg++;
+    }
+    snprintf(s->url, sizeof(s->url), "%s", arg);
+  } else if (strcmp(cmd, "play") == 0) {
+    if (s->url[0] != '\0') {
+      s->playing = true;
+    }
+    report(s->eventFd, MPD_EVENT_PLAY);
+  } else if (strcmp(cmd, "currentsong") == 0) {
+    if (s->url[0] != '\0') {
+      uint32_t song = songRequests++ / SONG_CHANGE_EVERY;
+      size_t used = strlen(out);
+      snprintf(out + used, outLen - used,
+               "file: %s\n"
+               "Title: Some Artist - Track Number %lu (Extended Mix)\n"
+               "Name: SomaFM: Bench Station: Commercial-free Internet Radio\n"
+               "Pos: 0\n"
+               "Id: %lu\n",
+               s->url, (unsigned long)song, (unsigned long)s->commands);
+    }
+  } else if (strcmp(cmd, "ping") == 0) {
+  } else {
+    size_t used = strlen(out);
+    snprintf(out + used, outLen - used, "ACK [5@%u] {%s} unknown command \"%s\"\n",
+             s->listIndex, cmd, cmd);
+    return false;
+  }
+  return true;
+}
+
+// handle one line from the client. returns false if the connection should be dropped.
+static bool handleLine(Session* s, uint32_t dropAfter, char* line) {
+  // like MPD, ignore trailing whitespace (the Arduino ends lines with "\r\n")
+  size_t len = strlen(line);
+  while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) {
+    line[--len] = '\0';
+  }
+
+  s->commands++;
+  if (dropAfter != 0 && s->commands > dropAfter) {
+    return false;
+  }
+
+  static char out[4096];
+  if (!s->inList) {
+    out[0] = '\0';
+  }
+
+  if (strcmp(line, "command_list_begin") == 0 || strcmp(line, "command_list_ok_begin") == 0) {
+    s->inList     = true;
+    s->listOk     = strcmp(line, "command_list_ok_begin") == 0;
+    s->listFailed = false;
+    s->listIndex  = 0;
+    return true;
+  }
+
+  if (s->inList && strcmp(line, "command_list_end") == 0) {
+    s->inList = false;
+    if (!s->listFailed) {
+      strncat(out, "OK\n", sizeof(out) - strlen(out) - 1);
+    }
+    sendString(s->fd, out);
+    report(s->eventFd, MPD_EVENT_RESPONSE);
+    return true;
+  }
+
+  if (s->inList) {
+    // after the first failure, MPD skips the rest of the list
+    if (!s->listFailed) {
+      s->listFailed = !runCommand(s, line, out, sizeof(out));
+      if (!s->listFailed && s->listOk) {
+        strncat(out, "list_OK\n", sizeof(out) - strlen(out) - 1);
+      }
+    }
+    s->listIndex++;
+    return true;
+  }
+
+  if (runCommand(s, line, out, sizeof(out))) {
+    strncat(out, "OK\n", sizeof(out) - strlen(out) - 1);
+  }
+  sendString(s->fd, out);
+  report(s->eventFd, MPD_EVENT_RESPONSE);
+  return true;
+}
+
+void fakeMpdServe(int listenFd, int eventFd, uint32_t dropAfter) {
+  for (;;) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+
+    Session s;
+    memset(&s, 0, sizeof(s));
+    s.fd      = fd;
+    s.eventFd = eventFd;
+    sendString(fd, "OK MPD 0.16.0\n");
+
+    char buf[1024];
+    size_t used = 0;
+    bool open = true;
+    while (open) {
+      ssize_t n = recv(fd, buf + used, sizeof(buf) - 1 - used, 0);
+      if (n <= 0) {
+        break;
+      }
+      used += n;
+      buf[used] = '\0';
+
+      // handle every complete line, and keep any partial one for next time
+      char* start = buf;
+      char* end;
+      while (open && (end = strchr(start, '\n')) != NULL) {
+        *end = '\0';
+        open = handleLine(&s, dropAfter, start);
+        start = end + 1;
+      }
+      used = buf + used - start;
+      memmove(buf, start, used);
+      if (used == sizeof(buf) - 1) {
+        // a line longer than the buffer; MPD would drop the client too
+        open = false;
+      }
+    }
+    close(fd);
+  }
+}
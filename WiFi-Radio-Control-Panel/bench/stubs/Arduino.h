@@ -0,0 +1,69 @@
+// minimal stand-in for the Arduino core, just enough to build control_panel.pde
+// on a Linux host. millis() and delay() run on a simulated clock that the bench
+// advances, and digital pins are plain variables the bench can drive.
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+
+#define NUM_DIGITAL_PINS 20
+
+uint32_t millis(void);
+void delay(uint32_t ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual void write(uint8_t c) = 0;
+  virtual void write(const char* str);
+  virtual void write(const uint8_t* buf, size_t size);
+
+  void print(const char* str);
+  void print(char c);
+  void print(int n, int base = DEC);
+  void print(unsigned int n, int base = DEC);
+  void print(long n, int base = DEC);
+  void print(unsigned long n, int base = DEC);
+
+  void println(void);
+  void println(const char* str);
+  void println(char c);
+  void println(int n, int base = DEC);
+  void println(unsigned int n, int base = DEC);
+  void println(long n, int base = DEC);
+  void println(unsigned long n, int base = DEC);
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(long baud);
+  void write(uint8_t c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_STUB_H
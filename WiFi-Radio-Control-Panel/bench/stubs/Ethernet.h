@@ -0,0 +1,36 @@
+// stand-in for the Arduino Ethernet library.
+// Client talks to a TCP socket on the local host instead of a W5100, so the
+// sketch can be run against the bench's fake MPD server.
+#ifndef ETHERNET_STUB_H
+#define ETHERNET_STUB_H
+
+#include <Arduino.h>
+
+class EthernetClass {
+public:
+  void begin(uint8_t* mac, uint8_t* ip) {}
+};
+
+extern EthernetClass Ethernet;
+
+class Client : public Print {
+  int fd_;
+  uint16_t port_;
+public:
+  // the address is ignored; the bench always connects to 127.0.0.1,
+  // on the port the fake server is listening on.
+  Client(uint8_t* ip, uint16_t port) : fd_(-1), port_(port) {}
+  uint8_t connect(void);
+  uint8_t connected(void);
+  int available(void);
+  int read(void);
+  // like the Arduino 0022 Client, flush discards any unread input
+  void flush(void);
+  void stop(void);
+
+  void write(uint8_t c);
+  void write(const char* str);
+  void write(const uint8_t* buf, size_t size);
+};
+
+#endif // ETHERNET_STUB_H
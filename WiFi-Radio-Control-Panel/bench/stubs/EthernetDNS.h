@@ -0,0 +1,4 @@
+// empty stand-in for the EthernetDNS library; the bench never resolves names.
+#ifndef ETHERNET_DNS_STUB_H
+#define ETHERNET_DNS_STUB_H
+#endif // ETHERNET_DNS_STUB_H
@@ -0,0 +1,29 @@
+// stand-in for the LiquidCrystal library.
+// it keeps a copy of what would be on the screen, and counts the bytes
+// the sketch sends to the display.
+#ifndef LIQUID_CRYSTAL_STUB_H
+#define LIQUID_CRYSTAL_STUB_H
+
+#include <Arduino.h>
+
+#define LCD_MAX_LINES   4
+#define LCD_MAX_COLUMNS 40
+
+class LiquidCrystal : public Print {
+  uint8_t cols_;
+  uint8_t lines_;
+  uint8_t row_;
+  uint8_t col_;
+public:
+  char screen[LCD_MAX_LINES][LCD_MAX_COLUMNS + 1];
+
+  LiquidCrystal(uint8_t rs, uint8_t enable,
+                uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+  void begin(uint8_t cols, uint8_t lines);
+  void clear(void);
+  void setCursor(uint8_t col, uint8_t row);
+  void write(uint8_t c);
+  using Print::write;
+};
+
+#endif // LIQUID_CRYSTAL_STUB_H
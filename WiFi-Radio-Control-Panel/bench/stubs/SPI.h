@@ -0,0 +1,4 @@
+// empty stand-in for the Arduino SPI library; the bench has no SPI bus.
+#ifndef SPI_STUB_H
+#define SPI_STUB_H
+#endif // SPI_STUB_H
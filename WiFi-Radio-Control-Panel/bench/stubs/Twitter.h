@@ -0,0 +1,15 @@
+// stand-in for the Twitter library: posts are counted, and always fail to connect,
+// so tweeting costs no time on the bench.
+#ifndef TWITTER_STUB_H
+#define TWITTER_STUB_H
+
+#include <Arduino.h>
+
+class Twitter {
+public:
+  Twitter(const char* token) {}
+  bool post(const char* msg);
+  int wait(void) { return 0; }
+};
+
+#endif // TWITTER_STUB_H
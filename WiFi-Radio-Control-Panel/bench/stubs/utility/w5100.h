@@ -0,0 +1,16 @@
+// stand-in for the W5100 driver behind the Ethernet library.
+// the bench's Client uses host sockets, so the retry settings are ignored.
+#ifndef W5100_STUB_H
+#define W5100_STUB_H
+
+#include <Arduino.h>
+
+class W5100Class {
+public:
+  void setRetransmissionTime(uint16_t timeout) {}
+  void setRetransmissionCount(uint8_t retry) {}
+};
+
+extern W5100Class W5100;
+
+#endif // W5100_STUB_H
@@ -1,5 +1,6 @@
 #include <SPI.h>
 #include <Ethernet.h>
+#include <utility/w5100.h>
 #include <EthernetDNS.h>
 #include <Twitter.h>
 #include <LiquidCrystal.h>
@@ -198,27 +199,29 @@ void renderDisplay(bool force = false) {
   }
 }
 
-// read a single line of text from the radioServer (until a newline is read)
-// into buffer, with a maximum length of len
-// returns true if it read anything, false if the radioServer didn't send anything
-bool getLine(char* buf, uint8_t len) {
-  uint8_t i = 0;
-  if (!radioServer.available()) {
-    return false;
-  }
-  // have to do len-1 to leave room for null character at end
-  while(radioServer.available() && i < len - 1) {
+// read a line of text from the radioServer (until a newline is read)
+// into buffer, with a maximum length of len, continuing after the *used characters
+// already read into it by previous calls.
+// returns true once the whole line has been read (the newline itself is not kept),
+// false if the radioServer ran out of data before the end of the line; in that case,
+// call again with the same buffer and used to read the rest of it.
+// a line too long for the buffer is cut short, and the rest of it is skipped.
+bool getLine(char* buf, uint8_t len, uint8_t* used) {
+  while(radioServer.available()) {
     char c = radioServer.read();
-    if (c != '\n') {
-      buf[i++] = c;
-    } else {
-      break;
+    if (c == '\n') {
+      buf[*used] = '\0'; // end string with a null;
+//      Serial.print("read line: ");
+//      Serial.println(buf);
+      return true;
+    }
+    // have to do len-1 to leave room for null character at end
+    if (*used < len - 1) {
+      buf[(*used)++] = c;
     }
   }
-  buf[i] = '\0'; // end string with a null;
-//  Serial.print("read line: ");
-//  Serial.println(buf);
-  return true;
+  buf[*used] = '\0';
+  return false;
 }
 
 // try and post the given message on twitter, print errors to Serial if unsuccessful
@@ -246,75 +249,158 @@ void tweet(const char* msg) {
 // how many seconds between updates of the currently-playing song
 #define SONG_UPDATE_TIME 5
 
+// time (in seconds) of the next periodic update of the currently-playing song
+// (anything else that fetches the song title pushes this back)
+uint32_t nextSongUpdate = 0;
+
+// how long, in milliseconds, to wait for the radio server to finish a response
+#define RESPONSE_TIMEOUT 500
+
 // this buffer holds the most recent twitter message,
 // so we don't try to send the same message more than once.
 char twitterMsg[SCROLL_BUF_LEN] = { '\0' };
 
+// read the radio server's response to a command (or a command list), line by line,
+// until it finishes with "OK" or fails with "ACK", or until RESPONSE_TIMEOUT expires.
+// if title is not NULL, the last line with the PREFIX is copied into it
+// (title must hold at least SCROLL_BUF_LEN characters)
+// returns true if the server answered "OK", false otherwise
+bool readResponse(char* title) {
+  // a buffer to read in the responses from the radio server, one line at a time
+  char line[SCROLL_BUF_LEN] = { '\0' };
+  // how much of the current line has been read so far
+  uint8_t used = 0;
+  uint32_t timeout = millis() + RESPONSE_TIMEOUT;
+
+  while (millis() < timeout && radioServer.connected()) {
+    if (!getLine(line, SCROLL_BUF_LEN, &used)) {
+      // no whole line there yet, give the server a moment to send more
+      delay(1);
+      continue;
+    }
+    // only look at whole lines, so the tail of one (e.g., "list_" + "OK") isn't taken for the end
+    used = 0;
+    if (strncmp(line, "OK", 2) == 0) {
+      return true;
+    }
+    if (strncmp(line, "ACK", 3) == 0) {
+      Serial.print("radio server error: ");
+      Serial.println(line);
+      return false;
+    }
+    if (title != NULL && strncmp(line, PREFIX, PREFIX_LEN) == 0) {
+      strncpy(title, line, SCROLL_BUF_LEN);
+    }
+  }
+  if (!radioServer.connected()) {
+    Serial.println("radio server disconnected during response.");
+  } else {
+    Serial.println("radio server response timed out.");
+  }
+  return false;
+}
+
+// display the given "Title: ..." response line in the 2nd line of the scroll buffer,
+// and tweet it if it's different from the last one.
+void showSongTitle(const char* songName) {
+//  Serial.print("found song name: ");
+//  Serial.print(songName + PREFIX_LEN);
+//  Serial.println("!");
+
+  // offset by PREFIX_LEN bytes, to skip the characters in "Title: " (which we don't want on the display)
+  // copy into the 2nd line of the scroll buffer (index 1), starting with the songName after the prefix
+  // copy either the full length of the songline, or at most, the maximum length of the buffer.
+  memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+  strncpy(scrollBuf[1], songName + PREFIX_LEN, min(strlen(songName + PREFIX_LEN), SCROLL_BUF_LEN - 1));
+//  Serial.print("scrollBuf[1]: ");
+//  Serial.println(scrollBuf[1]);
+
+  // build up a new twitter message, and if it's new, post it.
+  char newTwitterMsg[SCROLL_BUF_LEN] = { '\0' };
+  snprintf(newTwitterMsg, SCROLL_BUF_LEN - 1, "Now playing on %s: %s", stations[currentStation], (songName + PREFIX_LEN));
+  if (strncmp(newTwitterMsg, twitterMsg, strlen(newTwitterMsg)) != 0) {
+    Serial.print("Tweeting: '");
+    Serial.print(newTwitterMsg);
+    Serial.println("'");
+    tweet(newTwitterMsg);
+    strncpy(twitterMsg, newTwitterMsg, min(strlen(newTwitterMsg), SCROLL_BUF_LEN - 1));
+//  } else {
+//    Serial.print("Didn't tweet this message: '");
+//    Serial.print(newTwitterMsg);
+//    Serial.println("' : (");
+  }
+}
+
 // periodically request current status from the server
 // parse out the current artist and song, and pass it to the scroll buffer
 void updateSongTitle(bool force = false) {
-  // a buffer to read in the responses from the radio server, until we get the one we want
+  // a buffer to hold the title line of the response, if the server sends one
   char songName[SCROLL_BUF_LEN] = { '\0' };
 
-  static uint32_t nextUpdate = 0;
   uint32_t curSec = millis() / 1000;
   if ( strncmp(stations[currentStation], STOP, 4) == 0) {
     memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
-  } else if ((curSec > nextUpdate) || force) { // if it's time to update, or we're forced
+  } else if ((curSec > nextSongUpdate) || force) { // if it's time to update, or we're forced
        
-    nextUpdate = curSec + SONG_UPDATE_TIME;
+    nextSongUpdate = curSec + SONG_UPDATE_TIME;
 
     // send a command to the radioServer, requesting info about the currently-playing song  
     radioServer.println("currentsong");
-    bool inSongName = false;
-    bool doneWithSongName = false;
-    // wait for the server to respond
-    delay(10);
+
+    // read the whole response, so nothing is left over to confuse the next command,
+    // and if it had a title in it, show it.
+    if (readResponse(songName) && songName[0] != '\0') {
+      showSongTitle(songName);
+    }
+  }
+}
+
+// send the currently-selected station to the radio server, and update the display to match.
+// playing a station is sent as a single command list, so that the server handles
+// stop, clear, add, play and currentsong in one round-trip, and answers them all at once.
+void changeStation() {
+  // if instructed to stop, send stop command to the radio server
+  if (strcmp(stations[currentStation], STOP) == 0) { // last index
+//    Serial.print("stopping station.");
+    // command the radio server to stop the current station      
+    radioServer.println("stop");
+    readResponse(NULL);
+    memset(scrollBuf[0], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+    snprintf(scrollBuf[0], 9, "Stopped.");
+    memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+  } else {
+    // copy the station name into the first line (0 index) of the scroll buffer.   
+    memset(scrollBuf[0], '\0', SCROLL_BUF_LEN);   // set full line to blank spaces
+    strncpy(scrollBuf[0], stations[currentStation], min(strlen(stations[currentStation]), SCROLL_BUF_LEN-1));
+//    Serial.print("Starting station: ");
+//    Serial.println(stations[currentStation]);
     
-    // read lines one at a time from the server's response, into the songName buffer
-    while(getLine(songName, SCROLL_BUF_LEN)) {
-      // check if the temporary buffer the field has the right prefix
-      // if so, flush the remainder of the server's response, and break out of the loop
-      if (strncmp(songName, PREFIX, PREFIX_LEN) == 0) {
-        radioServer.flush();
-        break;
-      }
+    // begin a command list; the server will run everything up to command_list_end in order
+    radioServer.println("command_list_ok_begin");
+    // command the radio server to stop the previous station      
+    radioServer.println("stop");
+    // command the radio server to clear the playlist (so the previous station is removed)
+    radioServer.println("clear");
+    // command the radio server to add the new station to the playlist
+    radioServer.print("add ");
+    radioServer.println(urls[currentStation]);
+    // command the radio server to play the playlist
+    radioServer.println("play");
+    // ask for the currently playing song in the same batch, rather than in a separate update
+    radioServer.println("currentsong");
+    radioServer.println("command_list_end");
+
+    // each command answers "list_OK", and the list as a whole answers "OK" (or "ACK" at the first failure)
+    char songName[SCROLL_BUF_LEN] = { '\0' };
+    memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+    if (readResponse(songName) && songName[0] != '\0') {
+      showSongTitle(songName);
     }
-    // sanity check, in case we made it through the whole response without finding any matching lines
-    // if the buffer has the right prefix
-    if (strncmp(songName, PREFIX, PREFIX_LEN) == 0) {
-//      Serial.print("found song name: ");
-//      Serial.print(songName + PREFIX_LEN);
-//      Serial.println("!");
-//      Serial.print("strlen(songName):");
-//      Serial.println(strlen(songName));
-//      Serial.print("min(strlen(songName), SCROLL_BUF_LEN - 1): ");
-//      Serial.println(min(strlen(songName), SCROLL_BUF_LEN - 1));
-      
-      // offset by PREFIX_LEN bytes, to skip the characters in "Title: " (which we don't want on the display)
-      // copy into the 2nd line of the scroll buffer (index 1), starting with the songName after the prefix
-      // copy either the full length of the songline, or at most, the maximum length of the buffer.
-      memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
-      strncpy(scrollBuf[1], songName + PREFIX_LEN, min(strlen(songName + PREFIX_LEN), SCROLL_BUF_LEN - 1));
-//      Serial.print("scrollBuf[1]: ");
-//      Serial.println(scrollBuf[1]);
-
-      // build up a new twitter message, and if it's new, post it.
-      char newTwitterMsg[SCROLL_BUF_LEN] = { '\0' };
-      snprintf(newTwitterMsg, SCROLL_BUF_LEN - 1, "Now playing on %s: %s", stations[currentStation], (songName + PREFIX_LEN));
-      if (strncmp(newTwitterMsg, twitterMsg, strlen(newTwitterMsg)) != 0) {
-        Serial.print("Tweeting: '");
-        Serial.print(newTwitterMsg);
-        Serial.println("'");
-        tweet(newTwitterMsg);
-        strncpy(twitterMsg, newTwitterMsg, min(strlen(newTwitterMsg), SCROLL_BUF_LEN - 1));        
-//      } else {
-//        Serial.print("Didn't tweet this message: '");
-//        Serial.print(newTwitterMsg);
-//        Serial.println("' : ("); 
-      }
-    } 
+    // the list already asked for the song, so the periodic update can wait
+    nextSongUpdate = millis() / 1000 + SONG_UPDATE_TIME;
   }
+  // force an update of the display
+  renderDisplay(true);
 }
 
 // check to see if the (debounced) encoder value has changed (due to a new selection)
@@ -347,41 +433,81 @@ void checkDial() {
 //    Serial.print("Selected station: ");
 //    Serial.println(stations[currentStation]);
 
-    // if instructed to stop, send stop command to the radio server
-    if (strcmp(stations[currentStation], STOP) == 0) { // last index
-//      Serial.print("stopping station.");
-      // command the radio server to stop the current station      
-      radioServer.println("stop");
-      memset(scrollBuf[0], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
-      snprintf(scrollBuf[0], 9, "Stopped.");
-    } else {
-      // copy the station name into the first line (0 index) of the scroll buffer.   
-      memset(scrollBuf[0], '\0', SCROLL_BUF_LEN);   // set full line to blank spaces
-      strncpy(scrollBuf[0], stations[currentStation], min(strlen(stations[currentStation]), SCROLL_BUF_LEN-1));
-//      Serial.print("Starting station: ");
-//      Serial.println(stations[currentStation]);
-//      Serial.print("scrollBuf[0]: ");
-//      Serial.println(scrollBuf[0]);
-      
-      // command the radio server to stop the previous station      
-      radioServer.println("stop");
-      // command the radio server to clear the playlist (so the previous station is removed)
-      radioServer.println("clear");
-      // command the radio server to add the new station to the playlist
-      radioServer.print("add ");
-      radioServer.println(urls[currentStation]);
-      // command the radio server to play the playlist
-      radioServer.println("play");
-
-      // force an update of the currently playing song
-      // force an update of the display      
-      updateSongTitle(true);
-      renderDisplay(true);
-    }
+    changeStation();
     changed = true;
   }
 }
 
+// how long the W5100 waits for the radio server to answer before it resends a packet
+// (in units of 100 us, so 1000 is 100 ms), and how many times it resends before giving up.
+// connect() blocks until the server answers or the retries run out, so these keep an
+// attempt to reach an unreachable server to a second or two, rather than the W5100's
+// default of many seconds.
+#define W5100_RETRY_TIME  1000
+#define W5100_RETRY_COUNT 3
+
+// in milliseconds, how long to wait before the first attempt to reconnect to the radio server
+#define RECONNECT_MIN_DELAY 250
+// in milliseconds, the longest to wait between attempts to reconnect
+#define RECONNECT_MAX_DELAY 8000
+
+// check that we're still connected to the radio server, and if not, try to reconnect.
+// attempts are spaced out with exponential backoff, so the loop keeps running
+// (and the display keeps scrolling) in between.  each attempt itself still blocks:
+// if MPD is down but its host is up, the host refuses the connection right away,
+// but if the host is unreachable, connect() waits out the W5100's retries
+// (see W5100_RETRY_TIME and W5100_RETRY_COUNT), and the display stops scrolling meanwhile.
+// once reconnected, the current station and song title are sent again,
+// so that the radio server picks up where it left off (e.g., after MPD restarts).
+// returns true if connected, false otherwise
+bool checkConnection() {
+  // timer to mark when the next attempt to reconnect should be
+  static uint32_t reconnectTimer = 0;
+  // how long to wait after the next failed attempt
+  static uint32_t reconnectDelay = RECONNECT_MIN_DELAY;
+  // indicates that we've noticed the connection was lost
+  static bool     lost           = false;
+
+  if (radioServer.connected()) {
+    return true;
+  }
+
+  if (!lost) {
+    Serial.println();
+    Serial.println("disconnected.");
+    radioServer.stop();
+    memset(scrollBuf[0], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+    snprintf(scrollBuf[0], SCROLL_BUF_LEN, "connection lost.");
+    memset(scrollBuf[1], '\0', SCROLL_BUF_LEN );   // set full line to blank spaces
+    snprintf(scrollBuf[1], SCROLL_BUF_LEN, "reconnecting...");
+    renderDisplay(true);
+    lost           = true;
+    reconnectTimer = millis() + RECONNECT_MIN_DELAY;
+    reconnectDelay = RECONNECT_MIN_DELAY;
+  }
+
+  if (millis() < reconnectTimer) {
+    return false;
+  }
+
+  Serial.println("reconnecting...");
+  if (radioServer.connect()) {
+    Serial.println("connected!");
+    // consume the server's "OK MPD <version>" greeting
+    readResponse(NULL);
+    lost = false;
+    // resynchronise the server with the selected station, and the display with the server
+    changeStation();
+    return true;
+  }
+
+  // try again later, waiting twice as long (up to a limit) each time
+  radioServer.stop();
+  reconnectDelay = min(reconnectDelay * 2, RECONNECT_MAX_DELAY);
+  reconnectTimer = millis() + reconnectDelay;
+  return false;
+}
+
 // Arduino setup routine, happens once, before anything else
 void setup() {
   // set up the pins for the rotary encoder
@@ -396,6 +522,9 @@ void setup() {
 
   // start the Ethernet interface
   Ethernet.begin(mac, ip);
+  // don't let connecting to an unreachable radio server block for too long
+  W5100.setRetransmissionTime(W5100_RETRY_TIME);
+  W5100.setRetransmissionCount(W5100_RETRY_COUNT);
   // initialize the serial interface
   Serial.begin(9600);
 //  LCD.begin(115200);
@@ -420,6 +549,8 @@ void setup() {
     Serial.println("connected!");
     lcd.setCursor(0, 1);
     lcd.print("success!");
+    // consume the server's "OK MPD <version>" greeting
+    readResponse(NULL);
   } else {
     Serial.println("radio connection failed.");
     lcd.setCursor(0, 1);
@@ -435,6 +566,13 @@ void setup() {
 // Arduino loop routine, called repeatedly after setup.
 void loop() {
 
+  // if something goes wrong and we lose the connection, keep trying to get it back
+  // (without blocking), and keep the display scrolling the error in the meantime.
+  if (!checkConnection()) {
+    renderDisplay();
+    return;
+  }
+
   // check to see if the selection has changed,
   // update the song title (if necessary)
   // render the next scroll step of the display (if necessary)
@@ -444,16 +582,4 @@ void loop() {
   
   // flush output from radioServer
   radioServer.flush();
-
-  // if something goes wrong and we lose the connection, display an error and hang in infinite loop
-  if (!radioServer.connected()) {
-    lcd.clear();
-    lcd.print("connection lost.");
-    Serial.println();
-    Serial.println("disconnected.");
-    radioServer.stop();
-    for (;;) 
-      ;
-  }
 }
-